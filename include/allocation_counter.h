@@ -0,0 +1,16 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// Returns the number of heap allocations (calls to the global operator new)
+// performed by the program since it started.
+// The counter is updated by the replacement of operator new defined in
+// lib/allocation_counter.cpp, it is used to check that the filter chain
+// does not allocate once its buffers have been warmed up.
+size_t allocation_count();
+
+#endif
@@ -0,0 +1,102 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#ifndef CLASS_DETECTOR_H
+#define CLASS_DETECTOR_H
+
+#include <utility>
+#include <vector>
+#include <opencv2/features2d.hpp>
+
+#include "detection_workspace.h"
+#include "features_extractor.h"
+#include "features_matcher.h"
+#include "geometric_verifier.h"
+#include "template_matcher.h"
+#include "utils.h"
+
+// Scene data shared by the detectors of all the object classes.
+struct SceneData {
+    cv::Mat image; // Color scene.
+    cv::Mat gray;  // Gray scene, needed only by the template matching engine.
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+};
+
+// Outcome of the detection of an object class.
+struct Detection {
+    bool found = false;
+    // Top left corner and bottom right corner of the box.
+    std::pair<cv::Point2i, cv::Point2i> label;
+};
+
+// Detects one object class in the scene with the selected engine.
+// The model views are given in batches: each batch is processed and folded
+// into the running result of the class, so the views of a batch can be 
+// released as soon as add_views returns. Processing all the views in a 
+// single batch or in many batches leads to the same decision.
+class ClassDetector{
+
+    public:
+        // 'params', 'tm_params' and 'gv_params' are the parameters of the
+        // density filters, of the template matching and of the geometric
+        // verification (see main.cpp). 
+        ClassDetector(DetectionEngine engine, const std::vector<float>& params,
+                const std::vector<float>& tm_params, const std::vector<float>& gv_params,
+                const SceneData& scene, FeaturesExctractor& extractor, 
+                FeaturesMatcher& matcher, DetectionWorkspace& workspace);
+
+        // Process a batch of model views (grayscale).
+        void add_views(const std::vector<cv::Mat>& views);
+
+        // Returns true if the views processed so far are enough to decide, 
+        // the remaining views can be skipped.
+        bool done() const { return conclusive; }
+
+        // Take the decision with the views processed so far.
+        Detection decide();
+
+        // Number of heap allocations performed by the filter chain
+        // (feature extraction, matching and model fitting are excluded).
+        // Measured only by the feature engines.
+        size_t filter_allocations() const { return num_allocations; }
+
+        // Returns true if the engine measures the filter chain allocations.
+        bool counts_allocations() const { return engine != DetectionEngine::TEMPLATE; }
+
+    private:
+        DetectionEngine engine;
+        const std::vector<float>& params;
+        const std::vector<float>& tm_params;
+        const SceneData& scene;
+        FeaturesExctractor& extractor;
+        FeaturesMatcher& matcher;
+        DetectionWorkspace& workspace;
+        TemplateMatcher template_matcher;
+        GeometricVerifier verifier;
+        // Lowe's threshold of the matches used by the geometric verification.
+        float verification_ratio;
+
+        size_t num_allocations = 0;
+        // Number of views processed together (one for each thread by the
+        // geometric verification).
+        size_t chunk_size = 1;
+        // Number of views processed so far.
+        size_t num_views = 0;
+        // Set when a view is conclusive (geometric verification only).
+        bool conclusive = false;
+        // Best result (NCC score or number of inliers) of the views processed 
+        // so far, and its box.
+        double best_score = -1;
+        std::pair<cv::Point2i, cv::Point2i> best_label;
+
+        // Per view stages of the engines.
+        void add_views_template(const std::vector<cv::Mat>& views);
+        void add_views_verification(const std::vector<cv::Mat>& views);
+        void add_views_density(const std::vector<cv::Mat>& views);
+
+        // Position and density filters on the matched scene keypoints.
+        Detection decide_density();
+};
+
+#endif
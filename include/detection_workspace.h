@@ -0,0 +1,68 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#ifndef DETECTION_WORKSPACE_H
+#define DETECTION_WORKSPACE_H
+
+#include <vector>
+#include <opencv2/features2d.hpp>
+
+// Buffers used by the geometric verification of one model view.
+struct VerificationScratch {
+    // Matched points of the view and of the scene, sorted by match distance.
+    std::vector<cv::Point2f> model_points;
+    std::vector<cv::Point2f> scene_points;
+    // Flag of each match, set if the match is an inlier.
+    std::vector<unsigned char> inliers_mask;
+    // Corners of the object in the view and their projection in the scene.
+    std::vector<cv::Point2f> corners;
+    std::vector<cv::Point2f> projected;
+};
+
+// Scratch buffers used by the filter chain of every object class.
+// The buffers are cleared between two classes but never released, so once
+// they have grown to the size of the scene the filter chain does not
+// allocate anymore. A workspace must not be shared between threads.
+struct DetectionWorkspace {
+    // Knn matches between the current model view and the scene.
+    std::vector<std::vector<cv::DMatch>> view_matches;
+    // Matches that survived the Lowe's filter, one vector for each model 
+    // view processed together.
+    std::vector<std::vector<cv::DMatch>> good_matches;
+    // Buffers of the geometric verification, one for each model view 
+    // processed together. Each view is verified by one thread with its own
+    // buffers.
+    std::vector<VerificationScratch> verification;
+    // One flag for each scene keypoint, set when at least one model view
+    // has a good match on it.
+    std::vector<unsigned char> matched_keypoints;
+    // Positions of the matched scene keypoints, the filters compact this
+    // vector in place.
+    std::vector<cv::Point2i> points;
+    // Number of neighbors of each point (used by the neighbor filter).
+    std::vector<int> neighbors;
+
+    // Prepare the buffers for a new object class, processing up to 
+    // 'num_views' model views together. The scene has 'num_scene_keypoints'
+    // keypoints, which is also the max number of points that the filters
+    // can receive.
+    // The per view buffers only grow: a class that processes fewer views
+    // together keeps the buffers of the others for the next classes.
+    void reset(size_t num_views, size_t num_scene_keypoints) {
+        if (good_matches.size() < num_views) {
+            good_matches.resize(num_views);
+        }
+        if (verification.size() < num_views) {
+            verification.resize(num_views);
+        }
+        for (auto& view_good_matches : good_matches) {
+            view_good_matches.clear();
+        }
+        matched_keypoints.assign(num_scene_keypoints, 0);
+        points.clear();
+        points.reserve(num_scene_keypoints);
+        neighbors.reserve(num_scene_keypoints);
+    }
+};
+
+#endif
@@ -0,0 +1,73 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#ifndef GEOMETRIC_VERIFIER_H
+#define GEOMETRIC_VERIFIER_H
+
+#include <vector>
+#include <opencv2/features2d.hpp>
+
+#include "detection_workspace.h"
+
+// Decides if an object is in the scene by fitting, for each model view, a 
+// transformation that maps the view keypoints on the matched scene keypoints.
+// The box of the object is the projection of the object box of the best view.
+class GeometricVerifier{
+
+    public:
+        // Transformations that can be fitted between a view and the scene.
+        enum class Transform {
+            SIMILARITY, // Rotation, uniform scale and translation.
+            HOMOGRAPHY
+        };
+
+        // Outcome of the verification of a single view.
+        struct Verification {
+            int inliers = 0;          // 0 if the view was not verified.
+            double inliers_ratio = 0; // Inliers over the matches of the view.
+            cv::Rect box;             // Box of the object in the scene.
+        };
+
+        // 'reprojection_thresh' is the max distance (in pixels) between a
+        // projected view keypoint and its scene match to consider the match
+        // an inlier. A view is verified if it has at least 'min_inliers' inliers.
+        // A verified view with at least 'stop_inliers' inliers and an inliers
+        // ratio of at least 'stop_ratio' is conclusive: no other view is needed.
+        GeometricVerifier(Transform transform, double reprojection_thresh, int min_inliers,
+                int stop_inliers, double stop_ratio)
+            : transform(transform), reprojection_thresh(reprojection_thresh), 
+            min_inliers(min_inliers), stop_inliers(stop_inliers), stop_ratio(stop_ratio) { }
+
+        // Store the matched points of a view in 'scratch'. If the fit samples
+        // the best matches first (PROSAC) the matches are sorted by distance.
+        // The query indices refer to the view keypoints and the train indices
+        // to the scene keypoints.
+        void prepare_view(const std::vector<cv::KeyPoint>& keypoints_model,
+                const std::vector<cv::KeyPoint>& keypoints_scene, 
+                std::vector<cv::DMatch>& matches, VerificationScratch& scratch) const;
+
+        // Fit the transformation of the first results.size() views in parallel.
+        // The points of view i must have been prepared in scratch[i], the 
+        // object box in the view is models_boxes[i].
+        void verify(const std::vector<cv::Rect>& models_boxes, const cv::Size& scene_size,
+                std::vector<VerificationScratch>& scratch, 
+                std::vector<Verification>& results) const;
+
+        // Returns true if 'result' makes the verification of other views useless.
+        bool is_conclusive(const Verification& result) const {
+            return result.inliers >= stop_inliers && result.inliers_ratio >= stop_ratio;
+        }
+
+    private:
+        Transform transform;
+        double reprojection_thresh;
+        int min_inliers;
+        int stop_inliers;
+        double stop_ratio;
+
+        // Fit the transformation of a single view and check that it is plausible.
+        Verification fit_view(const cv::Rect& model_box, const cv::Size& scene_size,
+                VerificationScratch& scratch) const;
+};
+
+#endif
@@ -0,0 +1,26 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+
+// Returns the resident set size (RSS) of the process in bytes, 
+// or 0 if it cannot be read.
+size_t current_rss();
+
+// Returns the peak resident set size of the process in bytes, since the
+// start of the process.
+size_t peak_rss();
+
+// Start a new measurement window: window_peak_rss returns the peak resident
+// set size reached after this call. If the kernel cannot reset the peak, 
+// the window is the whole process life.
+void reset_window_peak();
+
+// Returns the peak resident set size in bytes since the last call of
+// reset_window_peak.
+size_t window_peak_rss();
+
+#endif
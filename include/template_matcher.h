@@ -0,0 +1,74 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#ifndef TEMPLATE_MATCHER_H
+#define TEMPLATE_MATCHER_H
+
+#include <utility>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// Detector that looks for the model views inside the scene using the
+// normalized cross correlation (NCC) over a pyramid of scales.
+// The NCC is masked: only the pixels of the object take part in it, the 
+// white background of the views is ignored. All the correlations are 
+// computed in the frequency domain.
+class TemplateMatcher{
+
+    public:
+        // 'scales' are the factors used to resize the model views.
+        TemplateMatcher(const std::vector<float>& scales) : scales(scales) { }
+
+        // Use 'num_scales' scales evenly spaced between 'min_scale' and 'max_scale'.
+        TemplateMatcher(float min_scale, float max_scale, int num_scales) {
+            float step = num_scales > 1 ? (max_scale - min_scale) / (num_scales - 1) : 0;
+            for (int i = 0; i < num_scales; i++) {
+                scales.push_back(min_scale + i * step);
+            }
+        }
+
+        // Set the model views (grayscale) of the object. Each view is cropped
+        // to the box of the object.
+        void set_models(const std::vector<cv::Mat>& models);
+
+        // Set the scene (grayscale) and compute its spectra, which are reused
+        // by every call of find_best_match.
+        void set_scene(const cv::Mat& scene);
+
+        // Search the best match of the model views in the scene.
+        // The views and the scales are processed in parallel.
+        // Returns the NCC score of the best match, in [-1, 1], and stores the
+        // top left corner and the bottom right corner of its box in 'label'.
+        // If no view fits inside the scene the returned score is -1.
+        double find_best_match(std::pair<cv::Point2i, cv::Point2i>& label) const;
+
+    private:
+        // Spectra of the scene and of its square, shared by all the views.
+        struct SceneSpectra {
+            cv::Size size;     // Size of the scene.
+            cv::Size dft_size; // Size of the DFT.
+            cv::Mat image;
+            cv::Mat squared;
+        };
+
+        // Best position of a (view, scale) pair in the scene.
+        struct Candidate {
+            double score = -1;
+            cv::Point2i top_left;
+            cv::Size size;
+        };
+
+        // Scales applied to the model views.
+        std::vector<float> scales;
+        // Model views cropped to the object.
+        std::vector<cv::Mat> views;
+        // Spectra of the current scene.
+        SceneSpectra spectra;
+
+        // Compute the best NCC position in the scene of the pair 'index', 
+        // which is view_index * scales.size() + scale_index.
+        // The spectra of the pair are computed here and released on return.
+        Candidate match_view(size_t index, const SceneSpectra& scene) const;
+};
+
+#endif
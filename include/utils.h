@@ -8,6 +8,14 @@
 #include <utility>
 #include <vector>
 
+// Engine used to detect an object class in the scene.
+enum class DetectionEngine {
+    FEATURES_DENSITY, // SIFT/FLANN matches filtered by position and density.
+    FEATURES,         // SIFT/FLANN matches verified with a geometric transformation 
+                      // (see GeometricVerifier).
+    TEMPLATE          // Normalized cross correlation of the views (see TemplateMatcher).
+};
+
 // Draw a box in the input image. The box is computed starting from the detected
 // keypoints. The drawn box contains all the detected keypoints.
 // Returns the top left corner and the bottom right corner of the box.
@@ -20,17 +28,33 @@ void lowe_filter(const std::vector<std::vector<cv::DMatch>>& matches, float thre
 
 // Filtering using max distance from 'center'.
 // All the points in 'points' that have a distance bigger than 'max_distance'
-// from 'center' are not added to 'filtered_points'.
-void max_distance_filter(float max_distance, const std::vector<cv::Point2i>& points,
-        cv::Point2f center, std::vector<cv::Point2i>& filtered_points);
+// from 'center' are removed from 'points' (in place), the order of the 
+// others is kept.
+void max_distance_filter(float max_distance, cv::Point2f center,
+        std::vector<cv::Point2i>& points);
 
 // For each point x in 'points' compute how many points have a distance
 // that is lower than 'max_distance'.
 // If point x has less than 'min_neighbors' neighbors, then it is
-// not added to filtered_points.
+// removed from 'points' (in place). The number of neighbors of each 
+// point is stored in 'neighbors', which is only used as scratch buffer.
 void neighbor_filter(int max_distance, int min_neighbors,
-        const std::vector<cv::Point2i>& points, 
-        std::vector<cv::Point2i>& filtered_points);
+        std::vector<cv::Point2i>& points, std::vector<int>& neighbors);
+
+// Store in 'points' the positions of the scene keypoints whose flag in 
+// 'matched_keypoints' is set. Keypoints that fall on the same pixel
+// are added only once. The previous content of 'points' is discarded.
+void collect_matched_points(const std::vector<unsigned char>& matched_keypoints,
+        const std::vector<cv::KeyPoint>& keypoints, std::vector<cv::Point2i>& points);
+
+// Compute the mask of the object inside a model view (grayscale): the 
+// pixels of the object are set to 255, the white background to 0.
+void object_mask(const cv::Mat& view, cv::Mat& mask);
+
+// Compute the box of the object inside a model view (grayscale): the 
+// white background of the view is excluded.
+// Returns an empty box if the view contains only background.
+cv::Rect object_box(const cv::Mat& view);
 
 // Compute center of mass of the points in 'points'.
 cv::Point2d compute_com(const std::vector<cv::Point2i>& points);
@@ -50,9 +74,21 @@ void get_all_filenames(const std::string& dir_path, std::vector<std::string>& fi
 //      pd_dir (power drill models dir path)
 //      mb_dir (mustard bottle models dir path)
 //      sb_dir  (sugar box models dir path)
+//      template_objects (letters p, m, s of the objects that must be 
+//                        detected with template matching)
+//      verification_objects (letters p, m, s of the objects that must be 
+//                        detected with the geometric verification)
+//      density_objects  (letters p, m, s of the objects that must be 
+//                        detected with the density filters)
+//      memory_ceiling   (max memory in megabytes for the streaming mode,
+//                        0 means no ceiling. It is left unchanged if the 
+//                        streaming mode is not requested)
 //  Function getopt is used to parse the command line.
-void parse_command_line(int argc, char* argv[], std::string& pd_dir, 
+//  Returns false if the value of an option is not valid.
+bool parse_command_line(int argc, char* argv[], std::string& pd_dir, 
         std::string& mb_dir, std::string& sb_dir, std::string& scene,
-        std::string& label);
+        std::string& label, std::string& template_objects, 
+        std::string& verification_objects, std::string& density_objects, 
+        long& memory_ceiling);
 
 #endif
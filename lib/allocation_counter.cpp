@@ -0,0 +1,37 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "../include/allocation_counter.h"
+
+// Number of calls to operator new. Relaxed increments are enough since
+// the value is only read to compute differences on the same thread.
+static std::atomic<size_t> num_allocations{0};
+
+size_t allocation_count() {
+    return num_allocations.load(std::memory_order_relaxed);
+}
+
+// Replacement of the global allocation functions. The array and nothrow
+// versions provided by the standard library forward to these ones.
+void* operator new(std::size_t size) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) {
+        size = 1;
+    }
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
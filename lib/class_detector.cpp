@@ -0,0 +1,222 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#include <algorithm>
+#include <iostream>
+#include <opencv2/core/utility.hpp>
+
+#include "../include/class_detector.h"
+#include "../include/allocation_counter.h"
+
+// Used to normalize the density of matches inside the colored box.
+const double scale_factor = 1000;
+
+// Used to expand the box of the density filters.
+const float expansion_ratio = 0.1;
+
+ClassDetector::ClassDetector(DetectionEngine engine, const std::vector<float>& params,
+        const std::vector<float>& tm_params, const std::vector<float>& gv_params,
+        const SceneData& scene, FeaturesExctractor& extractor, 
+        FeaturesMatcher& matcher, DetectionWorkspace& workspace)
+    : engine(engine), params(params), tm_params(tm_params), scene(scene), 
+    extractor(extractor), matcher(matcher), workspace(workspace),
+    template_matcher(tm_params[0], tm_params[1], tm_params[2]),
+    verifier(gv_params[0] == 0 ? GeometricVerifier::Transform::SIMILARITY 
+            : GeometricVerifier::Transform::HOMOGRAPHY, gv_params[1], gv_params[2],
+            gv_params[3], gv_params[4]), verification_ratio(gv_params[5]) {
+    // The geometric verification works on chunks of views, one view for
+    // each thread. The density filters need the matches of one view at a time.
+    if (engine == DetectionEngine::FEATURES) {
+        chunk_size = std::max(1, cv::getNumThreads());
+    }
+    // The spectra of the scene are computed once, not for every batch.
+    if (engine == DetectionEngine::TEMPLATE) {
+        template_matcher.set_scene(scene.gray);
+    }
+    workspace.reset(chunk_size, scene.keypoints.size());
+}
+
+void ClassDetector::add_views(const std::vector<cv::Mat>& views) {
+    switch (engine) {
+        case DetectionEngine::TEMPLATE:
+            add_views_template(views);
+            break;
+        case DetectionEngine::FEATURES:
+            add_views_verification(views);
+            break;
+        case DetectionEngine::FEATURES_DENSITY:
+            add_views_density(views);
+            break;
+    }
+}
+
+void ClassDetector::add_views_template(const std::vector<cv::Mat>& views) {
+    num_views += views.size();
+    // The views and the scales of the batch are searched in parallel.
+    template_matcher.set_models(views);
+    std::pair<cv::Point2i, cv::Point2i> label;
+    double score = template_matcher.find_best_match(label);
+    if (score > best_score) {
+        best_score = score;
+        best_label = label;
+    }
+}
+
+void ClassDetector::add_views_verification(const std::vector<cv::Mat>& views) {
+    // The views are verified in chunks, the views of a chunk are verified in
+    // parallel. Once a view is conclusive the remaining ones are skipped,
+    // and only the matches of one chunk are kept at a time.
+    const float ratio_thresh = verification_ratio;
+    std::vector<std::vector<cv::KeyPoint>> keypoints_models(chunk_size);
+    std::vector<cv::Rect> models_boxes(chunk_size);
+    std::vector<GeometricVerifier::Verification> results;
+    for (size_t start = 0; start < views.size() && !conclusive; start += chunk_size) {
+        const size_t count = std::min(chunk_size, views.size() - start);
+        for (size_t i = 0; i < count; i++) {
+            const cv::Mat& view = views[start + i];
+            cv::Mat descriptors_model;
+            extractor.extract_features(view, keypoints_models[i], descriptors_model);
+            matcher.compute_matches(workspace.view_matches, descriptors_model, scene.descriptors);
+
+            size_t allocations_before = allocation_count();
+            workspace.good_matches[i].clear();
+            lowe_filter(workspace.view_matches, ratio_thresh, workspace.good_matches[i]);
+            verifier.prepare_view(keypoints_models[i], scene.keypoints, 
+                    workspace.good_matches[i], workspace.verification[i]);
+            num_allocations += allocation_count() - allocations_before;
+
+            // Box of the object inside the view (the whole view if it is
+            // only background).
+            models_boxes[i] = object_box(view);
+            if (models_boxes[i].empty()) {
+                models_boxes[i] = cv::Rect(0, 0, view.cols, view.rows);
+            }
+        }
+
+        // Fit the transformation between each view of the chunk and the scene.
+        results.assign(count, GeometricVerifier::Verification());
+        verifier.verify(models_boxes, scene.image.size(), workspace.verification, results);
+        for (const GeometricVerifier::Verification& result : results) {
+            if (result.inliers > 0 && result.inliers > best_score) {
+                best_score = result.inliers;
+                best_label = std::make_pair(result.box.tl(), result.box.br());
+            }
+            conclusive = conclusive || verifier.is_conclusive(result);
+        }
+        num_views += count;
+    }
+}
+
+void ClassDetector::add_views_density(const std::vector<cv::Mat>& views) {
+    // The survivors of the Lowe's filter are marked on the scene keypoints,
+    // the flags are the running accumulator of the class.
+    std::vector<cv::DMatch>& good_matches = workspace.good_matches[0];
+    const float ratio_thresh = params[0]; // First parameter.
+    num_views += views.size();
+    for (const cv::Mat& view : views) {
+        std::vector<cv::KeyPoint> keypoints_model;
+        cv::Mat descriptors_model;
+        extractor.extract_features(view, keypoints_model, descriptors_model);
+        matcher.compute_matches(workspace.view_matches, descriptors_model, scene.descriptors);
+
+        size_t allocations_before = allocation_count();
+        good_matches.clear();
+        lowe_filter(workspace.view_matches, ratio_thresh, good_matches);
+        for (const auto& match : good_matches) {
+            workspace.matched_keypoints[match.trainIdx] = 1;
+        }
+        num_allocations += allocation_count() - allocations_before;
+    }
+}
+
+Detection ClassDetector::decide() {
+    Detection detection;
+    switch (engine) {
+        case DetectionEngine::TEMPLATE:
+            std::cout << "Best NCC score is " << best_score << std::endl;
+            detection.found = best_score >= tm_params[3];
+            break;
+        case DetectionEngine::FEATURES:
+            // The verified views already have enough inliers.
+            if (best_score <= 0) {
+                std::cout << "No model view survived the geometric verification..." << std::endl;
+            } else {
+                std::cout << "Best view has " << best_score << " inliers" << std::endl;
+            }
+            std::cout << "Views verified: " << num_views 
+                << (conclusive ? " (stopped at a conclusive view)" : "") << std::endl;
+            detection.found = best_score > 0;
+            break;
+        case DetectionEngine::FEATURES_DENSITY:
+            return decide_density();
+    }
+    detection.label = best_label;
+    return detection;
+}
+
+Detection ClassDetector::decide_density() {
+    Detection detection;
+    size_t allocations_before = allocation_count();
+
+    // Now we want to work only on the matched points found in the scene image.
+    // Therefore we take the positions of the marked scene keypoints 
+    // (removing the duplicates). From now on every filter compacts 
+    // 'workspace.points' in place.
+    std::vector<cv::Point2i>& points = workspace.points;
+    collect_matched_points(workspace.matched_keypoints, scene.keypoints, points);
+
+    // Check if anyone survived.
+    if (points.empty()) {
+        num_allocations += allocation_count() - allocations_before;
+        std::cout << "No matches survived the Lowe's ratio filter..." << std::endl;
+        return detection;
+    }
+
+    // Compute the center of mass of the points that survived the first filter.
+    cv::Point2i com = compute_com(points);
+
+    // Apply the second filter based on the position of the center of mass
+    // (COM) of the remaining points.
+    // All the points that have a distance from the COM that is bigger than
+    // 'max_dist_from_com' are filtered out.
+    float max_dist_from_com = params[1]; // Second parameter.
+    max_distance_filter(max_dist_from_com, com, points);
+
+    // Check if anyone survived.
+    if (points.empty()) {
+        num_allocations += allocation_count() - allocations_before;
+        std::cout << "No matches survived the second filter (distance from COM)..." << std::endl;
+        return detection;
+    }
+
+    // Third filter: remove the isolated points.
+    // Compute the number of neighbor considering 'max_dist_from_neighbor'
+    // as max value. Then neglect the point if the number of 
+    // neighbors is less then 'params[3]'.
+    int max_dist_from_neighbor = params[2]; // Third parameter.
+    neighbor_filter(max_dist_from_neighbor, params[3], points, workspace.neighbors);
+
+    // Printing the dimensione of the matches.
+    int num_points = points.size();
+    std::cout << "Final points survived: " << num_points << std::endl;
+
+    // Get the value of top left corner and bottom right bottom of the box.
+    detection.label = bounding_box_coord(scene.image, points, scene.keypoints, expansion_ratio);
+
+    // Compute the are inside the box.
+    double x_dim = detection.label.first.x - detection.label.second.x;
+    double y_dim = detection.label.first.y - detection.label.second.y;
+    double area = (x_dim * y_dim) / scale_factor; // Scale the area.
+    num_allocations += allocation_count() - allocations_before;
+
+    // Accept the box, if necessary.
+    if (area != 0) {
+        // Compute the density.
+        double density  = num_points / area;
+        std::cout<<"Density value is " << density <<std::endl;
+
+        // If density and number of points are high enough, then the object is detected.
+        detection.found = density > params[4] && num_points >= params[5];
+    }
+    return detection;
+}
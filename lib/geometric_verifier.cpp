@@ -0,0 +1,122 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "../include/geometric_verifier.h"
+
+// Parameters of the robust estimation: max number of iterations and 
+// confidence used to stop as soon as enough samples have been drawn.
+const int max_iterations = 2000;
+const double confidence = 0.995;
+
+// Range of the scale between the object in the view and in the scene.
+// Transformations outside this range are not plausible.
+const double min_scale = 0.2;
+const double max_scale = 2.0;
+
+// The homography is fitted with PROSAC when available. The similarity is
+// always fitted with RANSAC, since estimateAffinePartial2D has no USAC
+// variant (a full affine fitted with PROSAC was less accurate on the 
+// test scenes).
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 5)
+const int homography_method = cv::USAC_PROSAC;
+const bool homography_prosac = true;
+#else
+const int homography_method = cv::RANSAC;
+const bool homography_prosac = false;
+#endif
+
+void GeometricVerifier::prepare_view(const std::vector<cv::KeyPoint>& keypoints_model,
+        const std::vector<cv::KeyPoint>& keypoints_scene, 
+        std::vector<cv::DMatch>& matches, VerificationScratch& scratch) const {
+    // Sort the matches from the best to the worst, PROSAC samples the 
+    // best ones first. RANSAC samples uniformly, so the order is kept.
+    if (transform == Transform::HOMOGRAPHY && homography_prosac) {
+        std::sort(matches.begin(), matches.end());
+    }
+    scratch.model_points.clear();
+    scratch.scene_points.clear();
+    for (const cv::DMatch& match : matches) {
+        scratch.model_points.push_back(keypoints_model[match.queryIdx].pt);
+        scratch.scene_points.push_back(keypoints_scene[match.trainIdx].pt);
+    }
+}
+
+GeometricVerifier::Verification GeometricVerifier::fit_view(const cv::Rect& model_box, 
+        const cv::Size& scene_size, VerificationScratch& scratch) const {
+    Verification result;
+    // Number of matches needed to fit the transformation.
+    const size_t min_sample = transform == Transform::HOMOGRAPHY ? 4 : 2;
+    const size_t num_matches = scratch.model_points.size();
+    if (num_matches < std::max<size_t>(min_sample, min_inliers)) {
+        return result;
+    }
+
+    // Corners of the object in the view.
+    std::vector<cv::Point2f>& corners = scratch.corners;
+    corners.clear();
+    corners.push_back(cv::Point2f(model_box.x, model_box.y));
+    corners.push_back(cv::Point2f(model_box.x + model_box.width, model_box.y));
+    corners.push_back(cv::Point2f(model_box.x + model_box.width, model_box.y + model_box.height));
+    corners.push_back(cv::Point2f(model_box.x, model_box.y + model_box.height));
+
+    // Fit the transformation and project the corners in the scene.
+    std::vector<unsigned char>& inliers_mask = scratch.inliers_mask;
+    std::vector<cv::Point2f>& projected = scratch.projected;
+    if (transform == Transform::HOMOGRAPHY) {
+        cv::Mat H = cv::findHomography(scratch.model_points, scratch.scene_points, homography_method, 
+                reprojection_thresh, inliers_mask, max_iterations, confidence);
+        if (H.empty()) {
+            return result;
+        }
+        cv::perspectiveTransform(corners, projected, H);
+    } else {
+        cv::Mat S = cv::estimateAffinePartial2D(scratch.model_points, scratch.scene_points, 
+                inliers_mask, cv::RANSAC, reprojection_thresh, max_iterations, confidence);
+        if (S.empty()) {
+            return result;
+        }
+        cv::transform(corners, projected, S);
+    }
+
+    int num_inliers = cv::countNonZero(inliers_mask);
+    if (num_inliers < min_inliers) {
+        return result;
+    }
+
+    // Discard the degenerate transformations: the projected object must be
+    // a convex quadrilateral with a plausible size.
+    if (!cv::isContourConvex(projected)) {
+        return result;
+    }
+    double scale = std::sqrt(cv::contourArea(projected) / model_box.area());
+    if (scale < min_scale || scale > max_scale) {
+        return result;
+    }
+    cv::Rect box = cv::boundingRect(projected) & cv::Rect(0, 0, scene_size.width, scene_size.height);
+    if (box.empty()) {
+        return result;
+    }
+
+    result.inliers = num_inliers;
+    result.inliers_ratio = static_cast<double>(num_inliers) / num_matches;
+    result.box = box;
+    return result;
+}
+
+void GeometricVerifier::verify(const std::vector<cv::Rect>& models_boxes, 
+        const cv::Size& scene_size, std::vector<VerificationScratch>& scratch, 
+        std::vector<Verification>& results) const {
+    // Each view uses its own buffers and writes its own result, so the views
+    // can be verified in parallel.
+    cv::parallel_for_(cv::Range(0, results.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            results[i] = fit_view(models_boxes[i], scene_size, scratch[i]);
+        }
+    });
+}
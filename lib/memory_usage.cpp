@@ -0,0 +1,48 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "../include/memory_usage.h"
+
+// Peak resident set size of the windows closed by reset_window_peak.
+static size_t closed_windows_peak = 0;
+
+size_t current_rss() {
+    // The second field of statm is the number of resident pages.
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+size_t window_peak_rss() {
+    // The VmHWM line of status is the peak resident set size in kilobytes,
+    // it is reset by writing 5 to clear_refs.
+    std::ifstream status("/proc/self/status");
+    std::string field;
+    while (status >> field) {
+        if (field == "VmHWM:") {
+            size_t kilobytes = 0;
+            status >> kilobytes;
+            return kilobytes * 1024;
+        }
+    }
+    return current_rss();
+}
+
+size_t peak_rss() {
+    return std::max(closed_windows_peak, window_peak_rss());
+}
+
+void reset_window_peak() {
+    closed_windows_peak = peak_rss();
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
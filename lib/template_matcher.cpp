@@ -0,0 +1,139 @@
+// Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
+// (Read the report)
+
+#include <cmath>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "../include/template_matcher.h"
+#include "../include/utils.h"
+
+// Windows of the scene with a lower variance per pixel are considered flat
+// and skipped.
+const double min_variance = 1.0;
+
+// Min number of object pixels of a resized view.
+const int min_object_pixels = 16;
+
+// Compute the spectrum of 'image' placed in the top left corner of a
+// 'dft_size' image.
+static void spectrum(const cv::Mat& image, const cv::Size& dft_size, cv::Mat& result) {
+    cv::Mat padded;
+    cv::copyMakeBorder(image, padded, 0, dft_size.height - image.rows, 0, 
+            dft_size.width - image.cols, cv::BORDER_CONSTANT, cv::Scalar(0));
+    cv::dft(padded, result);
+}
+
+// Cross correlation between the scene and a template given their spectra:
+// correlation(y, x) is the sum of scene(y + j, x + i) * templ(j, i). 
+// The DFT is at least as big as the scene, so the positions where the 
+// template lies completely inside the scene are not affected by the 
+// circular wrap around.
+static void correlate(const cv::Mat& scene_spectrum, const cv::Mat& templ_spectrum, 
+        cv::Mat& correlation) {
+    cv::Mat product;
+    cv::mulSpectrums(scene_spectrum, templ_spectrum, product, 0, true);
+    cv::idft(product, correlation, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+}
+
+void TemplateMatcher::set_models(const std::vector<cv::Mat>& models) {
+    views.clear();
+    for (const cv::Mat& model : models) {
+        cv::Rect box = object_box(model);
+        if (box.empty()) {
+            continue;
+        }
+        views.push_back(model(box).clone());
+    }
+}
+
+TemplateMatcher::Candidate TemplateMatcher::match_view(size_t index, const SceneSpectra& scene) const {
+    Candidate best;
+    const cv::Mat& view = views[index / scales.size()];
+    const float scale = scales[index % scales.size()];
+    const cv::Size size(std::round(view.cols * scale), std::round(view.rows * scale));
+    if (size.width < 1 || size.height < 1 
+            || size.width > scene.size.width || size.height > scene.size.height) {
+        return best;
+    }
+
+    // Resize the view and compute the mask of the object.
+    cv::Mat resized, mask, mask_double;
+    cv::resize(view, resized, size, 0, 0, cv::INTER_AREA);
+    object_mask(resized, mask);
+    const double num_pixels = cv::countNonZero(mask);
+    if (num_pixels < min_object_pixels) {
+        return best;
+    }
+    mask.convertTo(mask_double, CV_64F, 1.0 / 255);
+
+    // Remove the mean of the object pixels and zero the background, so that
+    // the correlation with the scene is already the numerator of the NCC.
+    cv::Mat templ;
+    resized.convertTo(templ, CV_64F);
+    templ = (templ - cv::mean(templ, mask)).mul(mask_double);
+    const double templ_norm = cv::norm(templ, cv::NORM_L2);
+    if (templ_norm <= 0) {
+        return best;
+    }
+
+    // Numerator of the NCC, and sum and squared sum of the scene pixels 
+    // covered by the mask in each window.
+    cv::Mat templ_spectrum, mask_spectrum;
+    spectrum(templ, scene.dft_size, templ_spectrum);
+    spectrum(mask_double, scene.dft_size, mask_spectrum);
+    cv::Mat numerator, sum, sqsum;
+    correlate(scene.image, templ_spectrum, numerator);
+    correlate(scene.image, mask_spectrum, sum);
+    correlate(scene.squared, mask_spectrum, sqsum);
+
+    for (int y = 0; y + size.height <= scene.size.height; y++) {
+        const double* numerator_row = numerator.ptr<double>(y);
+        const double* sum_row = sum.ptr<double>(y);
+        const double* sqsum_row = sqsum.ptr<double>(y);
+        for (int x = 0; x + size.width <= scene.size.width; x++) {
+            double variance = sqsum_row[x] - sum_row[x] * sum_row[x] / num_pixels;
+            if (variance <= min_variance * num_pixels) {
+                continue;
+            }
+            double score = numerator_row[x] / (std::sqrt(variance) * templ_norm);
+            if (score > best.score) {
+                best.score = score;
+                best.top_left = cv::Point2i(x, y);
+            }
+        }
+    }
+    best.size = size;
+    return best;
+}
+
+void TemplateMatcher::set_scene(const cv::Mat& scene) {
+    // Spectra of the scene and of its square, shared by all the pairs.
+    spectra.size = scene.size();
+    spectra.dft_size = cv::Size(cv::getOptimalDFTSize(scene.cols), cv::getOptimalDFTSize(scene.rows));
+    cv::Mat scene_double;
+    scene.convertTo(scene_double, CV_64F);
+    spectrum(scene_double, spectra.dft_size, spectra.image);
+    spectrum(scene_double.mul(scene_double), spectra.dft_size, spectra.squared);
+}
+
+double TemplateMatcher::find_best_match(std::pair<cv::Point2i, cv::Point2i>& label) const {
+    // Each (view, scale) pair writes only its own candidate, so the pairs 
+    // can be processed in parallel.
+    std::vector<Candidate> candidates(views.size() * scales.size());
+    cv::parallel_for_(cv::Range(0, candidates.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            candidates[i] = match_view(i, spectra);
+        }
+    });
+
+    Candidate best;
+    for (const Candidate& candidate : candidates) {
+        if (candidate.score > best.score) {
+            best = candidate;
+        }
+    }
+    label.first = best.top_left;
+    label.second = cv::Point2i(best.top_left.x + best.size.width, best.top_left.y + best.size.height);
+    return best.score;
+}
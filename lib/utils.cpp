@@ -1,6 +1,10 @@
 // Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
 // (Read the report)
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <unistd.h>
@@ -9,6 +13,11 @@
 
 #include "../include/utils.h"
 
+// Distance between 'pt' and 'center', shared by all the distance based filters.
+static float point_distance(const cv::Point2i& pt, const cv::Point2f& center) {
+    return sqrt(pow(pt.x - center.x, 2) + pow(pt.y - center.y, 2));
+}
+
 std::pair<cv::Point2i, cv::Point2i> bounding_box_coord(const cv::Mat& image, 
         const std::vector<cv::Point2i>& points, const std::vector<cv::KeyPoint>& keypoints, 
         double expansion){
@@ -57,26 +66,70 @@ void lowe_filter(const std::vector<std::vector<cv::DMatch>>& matches, float thre
     }
 }
 
-void max_distance_filter(float max_distance, const std::vector<cv::Point2i>& points, 
-        cv::Point2f center, std::vector<cv::Point2i>& filtered_points){
-    for (const cv::Point2i& pt : points) {
-        float distance = sqrt(pow(pt.x - center.x, 2) + pow(pt.y - center.y, 2));
-        if (distance <= max_distance) {
-            filtered_points.push_back(pt);
+void max_distance_filter(float max_distance, cv::Point2f center,
+        std::vector<cv::Point2i>& points){
+    auto too_far = [&](const cv::Point2i& pt) {
+        return !(point_distance(pt, center) <= max_distance);
+    };
+    points.erase(std::remove_if(points.begin(), points.end(), too_far), points.end());
+}
+
+void neighbor_filter(int max_distance, int min_neighbors,
+        std::vector<cv::Point2i>& points, std::vector<int>& neighbors){
+    // The distance is symmetric, so each pair is visited only once.
+    // Every point is a neighbor of itself.
+    neighbors.assign(points.size(), 1);
+    for(size_t i = 0; i < points.size(); i++){
+        for(size_t j = i + 1; j < points.size(); j++){
+            if(point_distance(points[j], points[i]) <= max_distance){
+                neighbors[i]++;
+                neighbors[j]++;
+            }
         }
     }
+
+    // Compact the points that have enough neighbors.
+    size_t kept = 0;
+    for(size_t i = 0; i < points.size(); i++){
+        if(neighbors[i] > min_neighbors){
+            points[kept++] = points[i];
+        }
+    }
+    points.resize(kept);
 }
 
-void neighbor_filter(int max_distance, int min_neighbors, 
-        const std::vector<cv::Point2i>& points, 
-        std::vector<cv::Point2i>& filtered_points){
-    for(const auto& pt : points){
-        std::vector<cv::Point2i> kernel_points;
-        max_distance_filter(max_distance, points, pt, kernel_points);
-        if(kernel_points.size()> min_neighbors){
-            filtered_points.push_back(pt);
+void collect_matched_points(const std::vector<unsigned char>& matched_keypoints,
+        const std::vector<cv::KeyPoint>& keypoints, std::vector<cv::Point2i>& points){
+    points.clear();
+    for(size_t i = 0; i < matched_keypoints.size(); i++){
+        if(matched_keypoints[i]){
+            points.push_back(keypoints[i].pt);
         }
-    }   
+    }
+
+    // Remove duplicates: different keypoints can be rounded to the same pixel.
+    auto less = [](const cv::Point2i& a, const cv::Point2i& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    };
+    std::sort(points.begin(), points.end(), less);
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+}
+
+void object_mask(const cv::Mat& view, cv::Mat& mask){
+    // Pixels brighter than this value belong to the background.
+    const double background_thresh = 245;
+    cv::threshold(view, mask, background_thresh, 255, cv::THRESH_BINARY_INV);
+}
+
+cv::Rect object_box(const cv::Mat& view){
+    cv::Mat mask;
+    object_mask(view, mask);
+    std::vector<cv::Point2i> object_pixels;
+    cv::findNonZero(mask, object_pixels);
+    if (object_pixels.empty()) {
+        return cv::Rect();
+    }
+    return cv::boundingRect(object_pixels);
 }
 
 cv::Point2d compute_com(const std::vector<cv::Point2i>& points){
@@ -135,11 +188,28 @@ void get_all_filenames(const std::string& dir_path, std::vector<std::string>& fi
     }
 }
 
-void parse_command_line(int argc, char* argv[], std::string& pd_dir, 
+// Print the options accepted by the program.
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " -p <path> -m <path> -s <path> -i <path> -l <path> [-t <objects>] [-g <objects>] [-d <objects>] [-M <megabytes>]" << std::endl
+        << "  Where:" << std::endl
+        << "    -p is the power drill models dir path" << std::endl
+        << "    -m is the mustard bottle models dir path" << std::endl
+        << "    -s is the sugar box models dir path" << std::endl
+        << "    -i is the input scene image path" << std::endl
+        << "    -l is the label path associated with the scene" << std::endl
+        << "    -t are the objects (any of p, m, s) to detect with template matching" << std::endl
+        << "    -g are the objects (any of p, m, s) to detect with the geometric verification" << std::endl
+        << "    -d are the objects (any of p, m, s) to detect with the density filters" << std::endl
+        << "    -M enables the streaming mode with the given memory ceiling (0 for no ceiling)" << std::endl;
+}
+
+bool parse_command_line(int argc, char* argv[], std::string& pd_dir, 
         std::string& mb_dir, std::string& sb_dir, std::string& scene,
-        std::string& label) {
+        std::string& label, std::string& template_objects, 
+        std::string& verification_objects, std::string& density_objects, 
+        long& memory_ceiling) {
     int opt;
-    while ((opt = getopt(argc, argv, "s:p:m:i:l:")) != -1) {
+    while ((opt = getopt(argc, argv, "s:p:m:i:l:t:g:d:M:")) != -1) {
         switch (opt) {
             case 'p':
                 pd_dir = optarg;
@@ -156,15 +226,34 @@ void parse_command_line(int argc, char* argv[], std::string& pd_dir,
             case 'l':
                 label = optarg;
                 break;
+            case 't':
+                template_objects = optarg;
+                break;
+            case 'g':
+                verification_objects = optarg;
+                break;
+            case 'd':
+                density_objects = optarg;
+                break;
+            case 'M': {
+                // The ceiling must be a non negative integer, and small
+                // enough to be converted in bytes.
+                char* end = nullptr;
+                errno = 0;
+                long value = std::strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || value < 0
+                        || static_cast<unsigned long>(value) > SIZE_MAX / (1024 * 1024)) {
+                    std::cerr << "Error: invalid memory ceiling '" << optarg << "'" << std::endl;
+                    print_usage(argv[0]);
+                    return false;
+                }
+                memory_ceiling = value;
+                break;
+            }
             case '?':
-                std::cerr << "Usage: " << argv[0] << " -p <path> -m <path> -s <path> -i <path> -l <path>" << std::endl
-                    << "  Where:" << std::endl
-                    << "    -p is the power drill models dir path" << std::endl
-                    << "    -m is the mustard bottle models dir path" << std::endl
-                    << "    -s is the sugar box models dir path" << std::endl
-                    << "    -i is the input scene image path" << std::endl
-                    << "    -l is the label path associated with the scene" << std::endl;
+                print_usage(argv[0]);
                 break;
         }
     }
+    return true;
 }
@@ -1,6 +1,7 @@
 // Authors: Chinello Alessandro, Piai Luca, Scantamburlo Mattia
 // (Read the report)
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 
@@ -10,14 +11,11 @@
 #include <opencv2/imgproc.hpp>
 
 #include "../include/utils.h"
-#include "../include/features_extractor.h"
-#include "../include/features_matcher.h"
+#include "../include/class_detector.h"
+#include "../include/memory_usage.h"
 #include "../include/performance_metrics.h"
 
 
-// Used to normalize the density of matches inside the colored box.
-const double scale_factor = 1000;
-
 // Parameters associated to each object class.
 // The value below are not magic numbers, they were determinated
 // during the tuning phase.
@@ -33,6 +31,49 @@ const std::vector<float> pd_params = {0.8, 152, 50, 10, 1.0, 35};
 const std::vector<float> mb_params = {0.8, 150, 80, 15, 0.8, 50};
 const std::vector<float> sb_params = {0.75, 160, 80, 20, 1.25, 40};
 
+// Parameters of the template matching engine associated to each object class.
+// The scales cover the size of the objects in the test images (0.64 to 1.44
+// times their size in the views). On the test images the best NCC score of 
+// a scene without the object is as high as the one of a scene with it, so
+// the thresholds are just above the best score of the scenes without the 
+// object: the engine does not report false positives, but it rarely finds
+// the objects.
+// Used for:
+//      - Smallest scale applied to the views,
+//      - Biggest scale applied to the views,
+//      - Number of scales (evenly spaced between the two above),
+//      - Min NCC score to consider the object detected.
+const std::vector<float> pd_tm_params = {0.6, 1.3, 8, 0.8};
+const std::vector<float> mb_tm_params = {0.6, 1.3, 8, 0.82};
+const std::vector<float> sb_tm_params = {0.6, 1.3, 8, 0.6};
+
+// Parameters of the geometric verification associated to each object class.
+// They were tuned on the test images of the dataset.
+// Used for:
+//      - Transformation fitted between the views and the scene
+//        (0 similarity, 1 homography). The sugar box is a box with flat
+//        faces, so a face is mapped exactly by a homography; the power 
+//        drill and the mustard bottle are not planar and the homography 
+//        overfits their matches,
+//      - Max reprojection error of an inlier (in pixels),
+//      - Min number of inliers to consider the object detected,
+//      - Min number of inliers of a conclusive view (the remaining views
+//        are not verified),
+//      - Min inliers ratio of a conclusive view,
+//      - Lowe's threshold value of the matches (the fit rejects the wrong
+//        matches, so it is looser than the one of the density filters).
+const std::vector<float> pd_gv_params = {0, 5, 8, 30, 0.5, 0.85};
+const std::vector<float> mb_gv_params = {0, 8, 8, 30, 0.5, 0.85};
+const std::vector<float> sb_gv_params = {1, 5, 12, 30, 0.5, 0.85};
+
+// Default detection engine of each object class, chosen on the test images
+// of the dataset. The geometric verification finds the sugar box and the 
+// mustard bottle more often than the density filters, while the power 
+// drill has too few distinctive matches to fit a transformation.
+const DetectionEngine pd_engine = DetectionEngine::FEATURES_DENSITY;
+const DetectionEngine mb_engine = DetectionEngine::FEATURES;
+const DetectionEngine sb_engine = DetectionEngine::FEATURES;
+
 // Id associated to each object class.
 const std::string pd_obj_name = "035_power_drill";
 const std::string mb_obj_name = "006_mustard_bottle";
@@ -45,9 +86,19 @@ int main(int argc, char* argv[]) {
     std::string pd_models_dirpath{}; // Power drill models dir path
     std::string mb_models_dirpath{}; // Mustar bottle models dir path
     std::string sb_models_dirpath{}; // Sugar box models dir path
-    parse_command_line(argc, argv, pd_models_dirpath, mb_models_dirpath, sb_models_dirpath, scene_image_path, label_scene_path);
-
-    if (pd_models_dirpath.empty() || mb_models_dirpath.empty() 
+    std::string template_objects{};  // Objects detected with template matching.
+    std::string verification_objects{}; // Objects detected with the geometric verification.
+    std::string density_objects{};   // Objects detected with the density filters.
+    long memory_ceiling_mb = -1;     // Memory ceiling of the streaming mode (MB).
+    bool parsed = parse_command_line(argc, argv, pd_models_dirpath, mb_models_dirpath, 
+            sb_models_dirpath, scene_image_path, label_scene_path, template_objects, 
+            verification_objects, density_objects, memory_ceiling_mb);
+
+    // The streaming mode is enabled by the memory ceiling (0 means no ceiling).
+    const bool streaming = memory_ceiling_mb >= 0;
+    const size_t memory_ceiling = streaming ? static_cast<size_t>(memory_ceiling_mb) * 1024 * 1024 : 0;
+
+    if (!parsed || pd_models_dirpath.empty() || mb_models_dirpath.empty() 
             || sb_models_dirpath.empty() || scene_image_path.empty()
             || label_scene_path.empty()) {
         std::cerr << "Error in parsing the command line... aborting.\n";
@@ -80,149 +131,175 @@ int main(int argc, char* argv[]) {
     params_map[pd_obj_name] = pd_params;
     params_map[mb_obj_name] = mb_params;
     params_map[sb_obj_name] = sb_params;
+    std::map<std::string, std::vector<float>> tm_params_map;
+    tm_params_map[pd_obj_name] = pd_tm_params;
+    tm_params_map[mb_obj_name] = mb_tm_params;
+    tm_params_map[sb_obj_name] = sb_tm_params;
+
+    std::map<std::string, std::vector<float>> gv_params_map;
+    gv_params_map[pd_obj_name] = pd_gv_params;
+    gv_params_map[mb_obj_name] = mb_gv_params;
+    gv_params_map[sb_obj_name] = sb_gv_params;
+
+    // Define the detection engine used for each object class, the command
+    // line can select a different one for each object.
+    std::map<char, std::string> objects_letters;
+    objects_letters['p'] = pd_obj_name;
+    objects_letters['m'] = mb_obj_name;
+    objects_letters['s'] = sb_obj_name;
+    std::map<std::string, DetectionEngine> engines_map;
+    engines_map[pd_obj_name] = pd_engine;
+    engines_map[mb_obj_name] = mb_engine;
+    engines_map[sb_obj_name] = sb_engine;
+    const std::vector<std::pair<std::string, DetectionEngine>> engines_selection = {
+        {template_objects, DetectionEngine::TEMPLATE},
+        {verification_objects, DetectionEngine::FEATURES},
+        {density_objects, DetectionEngine::FEATURES_DENSITY}
+    };
+    std::string selected_objects;
+    for (const auto& selection : engines_selection) {
+        for (char obj : selection.first) {
+            if (objects_letters.count(obj) == 0) {
+                std::cerr << "Error: unknown object '" << obj << "' in the engines selection!" << std::endl;
+                return -1;
+            }
+            if (selected_objects.find(obj) != std::string::npos) {
+                std::cerr << "Error: object '" << obj << "' selected for more than one engine!" << std::endl;
+                return -1;
+            }
+            selected_objects.push_back(obj);
+            engines_map[objects_letters[obj]] = selection.second;
+        }
+    }
 
     // Define the output scene image (the one with the boxes plotted).
-    cv::Mat out_scene = cv::imread(scene_image_path, cv::IMREAD_COLOR);
-    if(out_scene.empty()) {
+    SceneData scene;
+    scene.image = cv::imread(scene_image_path, cv::IMREAD_COLOR);
+    if(scene.image.empty()) {
         std::cerr << "Error: the image of the scene was not loaded correctly!" << std::endl;
         return -1;
     }
-    cv::Mat out_scene_gray;
-    cv::cvtColor(out_scene, out_scene_gray, cv::COLOR_BGR2GRAY);
+    cv::cvtColor(scene.image, scene.gray, cv::COLOR_BGR2GRAY);
 
     // Define the feature extractor that will be used to detect the objects.
     FeaturesExctractor extractor = FeaturesExctractor();
 
-    // Define the vectors containing the keypoints and the descriptors of the scene.
-    std::vector<cv::KeyPoint> keypoints_scene;
-    cv::Mat descriptors_scene;
-    extractor.extract_features(out_scene_gray, keypoints_scene, descriptors_scene);
+    // Compute the keypoints and the descriptors of the scene.
+    extractor.extract_features(scene.gray, scene.keypoints, scene.descriptors);
+
+    // In streaming mode the gray scene is kept only if the template matching
+    // engine needs it, the other engines use only the scene features.
+    bool template_needed = false;
+    for (const auto& obj : engines_map) {
+        template_needed = template_needed || obj.second == DetectionEngine::TEMPLATE;
+    }
+    if (streaming && !template_needed) {
+        scene.gray.release();
+    }
 
     // Define the feature matcher.
     FeaturesMatcher matcher = FeaturesMatcher();
 
+    // Define the buffers reused by the filter chain of every object class.
+    DetectionWorkspace workspace;
+
     // Define the models images.
     for(const auto& models_path : images_models_paths){
  
         std::cout << "Looking for " << models_path.first << " in the scene image..." << std::endl;
-        // Define a vector containing all the models images of the current object.
+        ClassDetector detector(engines_map[models_path.first], params_map[models_path.first],
+                tm_params_map[models_path.first], gv_params_map[models_path.first],
+                scene, extractor, matcher, workspace);
+
+        // The scene data and the buffers are kept for the whole class, if 
+        // they already fill the memory ceiling no view can be processed.
+        if (memory_ceiling > 0 && current_rss() >= memory_ceiling) {
+            std::cerr << "Error: the resident memory before the views of " << models_path.first 
+                << " is " << current_rss() / (1024 * 1024) << " MB, over the memory ceiling!" << std::endl;
+            return -1;
+        }
+
+        // In batch mode all the views are loaded and processed together. In
+        // streaming mode they are processed in batches: the first batch has
+        // one view, the next ones are sized to fit in the memory ceiling
+        // (one view at a time without a ceiling). Only the loaded views pile
+        // up in a batch, their features are computed one view at a time, so
+        // a batch needs the measured working memory plus its views.
+        size_t batch_size = streaming ? 1 : models_path.second.size();
+        size_t loaded_views = 0;
+        size_t working_bytes = 0; // Max memory used by a batch besides its views.
+        size_t view_bytes = 0;    // Max size of a loaded view.
         std::vector<cv::Mat> models;
         for (const std::string& p : models_path.second) {
+            // The remaining views cannot change the decision.
+            if (detector.done()) {
+                break;
+            }
+
             cv::Mat model = cv::imread(p, cv::IMREAD_GRAYSCALE);
             if(model.empty()){
                 std::cerr<<"Error: the model image " << p << "was not loaded correctly!"<<std::endl;
                 return -1;
             }
-            models.push_back(model);
-        }
-
-        // Keypoints and descriptor of each model.
-        std::vector<std::vector<cv::KeyPoint>> keypoints_models(models.size());
-        std::vector<cv::Mat> descriptors_models(models.size());
-        // Compute keypoints and descriptors.
-        for (int i = 0; i < models.size(); i++) {
-            extractor.extract_features(models[i], keypoints_models[i], descriptors_models[i]);
-        }
-
-        // Vector that stores matches found by the matcher.
-        std::vector<std::vector<cv::DMatch>> knn_matches;
-        // Compute the matches between the scene and each model.
-        for (int i = 0; i < models.size(); i++) {
-            std::vector<std::vector<cv::DMatch>> tmp;
-            matcher.compute_matches(tmp, descriptors_models[i], descriptors_scene);
-            knn_matches.insert(knn_matches.end(), tmp.begin(), tmp.end());
+            view_bytes = std::max(view_bytes, model.total() * model.elemSize());
+            models.push_back(std::move(model));
+            loaded_views++;
+            if (models.size() < batch_size) {
+                continue;
+            }
+            size_t batch_start_rss = current_rss();
+            if (memory_ceiling > 0) {
+                reset_window_peak();
+            }
+            detector.add_views(models);
+            models.clear();
+
+            if (memory_ceiling > 0) {
+                size_t batch_peak = window_peak_rss();
+                if (batch_peak > memory_ceiling) {
+                    std::cerr << "Error: the views of " << models_path.first << " reached " 
+                        << batch_peak / (1024 * 1024) << " MB of resident memory, over the memory ceiling!" 
+                        << std::endl;
+                    return -1;
+                }
+                if (batch_peak > batch_start_rss) {
+                    working_bytes = std::max(working_bytes, batch_peak - batch_start_rss);
+                }
+                size_t used_bytes = current_rss() + working_bytes;
+                batch_size = 1;
+                if (used_bytes < memory_ceiling && view_bytes > 0) {
+                    batch_size = std::max<size_t>(1, (memory_ceiling - used_bytes) / view_bytes);
+                }
+            }
         }
-
-        // Apply the first filter to the matches found previousliy.
-        // The first filter is the lowe's filter.
-        const float ratio_thresh = params_map[models_path.first][0]; // First parameter.
-        std::vector<cv::DMatch> good_matches;
-        lowe_filter(knn_matches, ratio_thresh, good_matches);
-
-        // Check if anyone survived.
-        if (good_matches.empty()) {
-            std::cout << "No matches survived the Lowe's ratio filter..." << std::endl;
-            continue;
+        if (!models.empty()) {
+            detector.add_views(models);
         }
-
-        // Now we want to work only on the matched points found in the scene image.
-        // Therefore we convert the vector of DMatch into a vector of Point2i
-        // corresponding to the maches positions of the scene image.
-        std::vector<cv::Point2i> good_points;
-        for(const auto& match : good_matches) {
-            // Find the position of the match in the scene.
-            cv::Point2i pt = keypoints_scene[match.trainIdx].pt;
-            // Add the position only if it is not already present (aka remove duplicates).
-            if(std::find(good_points.begin(), good_points.end(), pt) == good_points.end()) {
-                good_points.push_back(pt);
-            }
+        if (streaming) {
+            std::cout << "Views loaded: " << loaded_views << " of " << models_path.second.size() 
+                << " (batches of up to " << batch_size << " views)" << std::endl;
+            std::cout << "Resident memory after the views: " << current_rss() / (1024 * 1024) 
+                << " MB" << std::endl;
         }
 
-        // Compute the center of mass of the points that survived the first filter.
-        cv::Point2i com = compute_com(good_points);
-
-        // Apply the second filter based on the position of the center of mass
-        // (COM) of the remaining points.
-        // All the points that have a distance from the COM that is bigger than
-        // 'max_dist_from_com' are filtered out.
-        float max_dist_from_com = params_map[models_path.first][1]; // Second parameter.
-        std::vector<cv::Point2i> filtered_points;
-        max_distance_filter(max_dist_from_com, good_points, com, filtered_points);
-
-        // Check if anyone survived.
-        if (filtered_points.empty()) {
-            std::cout << "No matches survived the second filter (distance from COM)..." << std::endl;
-            continue;
+        Detection detection = detector.decide();
+        if (detector.counts_allocations()) {
+            std::cout << "Heap allocations in the filter chain: " << detector.filter_allocations() << std::endl;
         }
 
-        // Third filter: remove the isolated points.
-        // Compute the number of neighbor considering 'max_dist_from_neighbor'
-        // as max value. Then neglect the point if the number of 
-        // neighbors is less then 'params_map[models_path.first][3]'.
-        std::vector<cv::Point2i> final_points;
-        int max_dist_from_neighbor = params_map[models_path.first][2]; // Third parameter.
-        neighbor_filter(max_dist_from_neighbor, params_map[models_path.first][3], filtered_points, final_points);
-
-        // Printing the dimensione of the matches.
-        int num_points = final_points.size();
-        std::cout << "Final points survived: " << num_points << std::endl;
-
-        // Draw the filtered matches.
-        //for (const auto& pt : final_points) {
-        //    cv::circle(out_scene, pt, 3, boxes_color[models_path.first], 2);
-        //}
-
-        // Recalculate the center of mass with the filtered matches.
-        cv::Point2i new_com = compute_com(final_points);
-
-        // Draw the center of mass.
-        //cv::circle(out_scene, new_com, 5, cv::Scalar(0, 255, 255), 2);
-
-        // Get the value of top left corner and bottom right bottom of the box.
-        const float expansion_ratio = 0.1; // Used to expand the box.
-        std::pair<cv::Point2i, cv::Point2i> label = bounding_box_coord(out_scene, final_points, keypoints_scene, expansion_ratio);
-        cv::Point2i top_left = label.first;
-        cv::Point2i bottom_right = label.second;
-        
-        // Compute the are inside the box.
-        double x_dim = label.first.x - label.second.x;
-        double y_dim = label.first.y - label.second.y;
-        double area = (x_dim * y_dim) / scale_factor; // Scale the area.
-
-        // Draw the box, if necessary.
-        if (area != 0) {
-            // Compute the density.
-            double density  = num_points / area;
-            std::cout<<"Density value is " << density <<std::endl;
-
-            // If density and number of points are high enough, then draw the box.
-            if (density > params_map[models_path.first][4] && num_points >= params_map[models_path.first][5]) {
-                rectangle(out_scene, top_left, bottom_right, boxes_color[models_path.first], 2, cv::LINE_8);  
-                // Store the found label.
-                store_label("output_label.txt", models_path.first, label.first, label.second);
-            }
+        // Draw the box, if the object was detected.
+        if (detection.found) {
+            rectangle(scene.image, detection.label.first, detection.label.second, 
+                    boxes_color[models_path.first], 2, cv::LINE_8);
+            // Store the found label.
+            store_label("output_label.txt", models_path.first, detection.label.first, detection.label.second);
         }
+    }
 
+    std::cout << "Peak resident memory: " << peak_rss() / (1024 * 1024) << " MB" << std::endl;
+    if (memory_ceiling > 0 && peak_rss() > memory_ceiling) {
+        std::cerr << "Warning: the peak resident memory is over the memory ceiling of " 
+            << memory_ceiling / (1024 * 1024) << " MB!" << std::endl;
     }
 
     // Compute the metrics.
@@ -232,7 +309,7 @@ int main(int argc, char* argv[]) {
     std::cout<< std::endl;
 
     // Plot the final result.
-    cv::imshow("Filtered Matches on Scene", out_scene);
+    cv::imshow("Filtered Matches on Scene", scene.image);
     cv::waitKey();
     return 0;
 }